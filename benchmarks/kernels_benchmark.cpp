@@ -0,0 +1,293 @@
+/*
+    Micro-benchmark of the solver kernels.
+
+    Usage: ./bins/kernels_benchmark [--perf] <testset files...>
+    - Every kernel runs on fixed-seed inputs built from each testset file
+    - Report ns/op and throughput, plus hardware counters per op with --perf
+*/
+
+#define CURRENT_MODE BENCHMARK_MODE
+#include "../vehicle_routing.cpp"
+
+#include <fstream>
+#include <linux/perf_event.h>
+#include <sstream>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/* --- BENCHMARK CONSTANTS --- */
+
+constexpr int BENCHMARK_SEED = 42;
+constexpr int BENCHMARK_MIN_MILLISECONDS = 100;
+constexpr int BENCHMARK_OPS_PER_CHUNK = 256; // Kernels reset their input between chunks
+
+// Keep kernel results alive so the compiler cannot drop the calls
+volatile long long benchmark_sink;
+
+/* --- HARDWARE COUNTERS --- */
+
+constexpr int N_PERF_COUNTERS = 4;
+
+const char *PERF_COUNTER_NAMES[N_PERF_COUNTERS] = {"cycles", "instr", "br-miss", "cache-miss"};
+const int   PERF_COUNTER_CONFIGS[N_PERF_COUNTERS] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES,
+    PERF_COUNT_HW_CACHE_MISSES
+};
+
+bool global_perf_enabled = false;
+int  global_perf_fds[N_PERF_COUNTERS];
+
+// Open all counters as one group, leaving perf disabled if any of them is unavailable
+bool init_perf_counters()
+{
+    for (int i = 0; i < N_PERF_COUNTERS; i++)
+    {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNTER_CONFIGS[i];
+        attr.disabled = i == 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+
+        int group_fd = i == 0 ? -1 : global_perf_fds[0];
+        global_perf_fds[i] = syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0);
+        if (global_perf_fds[i] < 0)
+        {
+            fprintf(
+                stderr, "init_perf_counters(): perf_event_open() failed for %s: %s\n",
+                PERF_COUNTER_NAMES[i], strerror(errno)
+            );
+            for (int j = 0; j < i; j++)
+                close(global_perf_fds[j]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void start_perf_counters()
+{
+    if (global_perf_enabled)
+        ioctl(global_perf_fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+void stop_perf_counters()
+{
+    if (global_perf_enabled)
+        ioctl(global_perf_fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+}
+
+void reset_perf_counters()
+{
+    if (global_perf_enabled)
+        ioctl(global_perf_fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+}
+
+void read_perf_counters(long long *counts)
+{
+    // PERF_FORMAT_GROUP layout: counter count, then one value per counter
+    long long values[N_PERF_COUNTERS + 1];
+    if (read(global_perf_fds[0], values, sizeof(values)) != sizeof(values))
+    {
+        memset(counts, 0, sizeof(long long) * N_PERF_COUNTERS);
+        return;
+    }
+    memcpy(counts, &values[1], sizeof(long long) * N_PERF_COUNTERS);
+}
+
+/* --- BENCHMARK RUNNER --- */
+
+void print_benchmark_header()
+{
+    printf("%-36s %12s %12s", "kernel", "ns/op", "Mops/s");
+    if (global_perf_enabled)
+        for (int i = 0; i < N_PERF_COUNTERS; i++)
+            printf(" %12s", PERF_COUNTER_NAMES[i]);
+    printf("\n");
+}
+
+// Time chunks of op() calls until BENCHMARK_MIN_MILLISECONDS, reset() runs untimed before each
+template <typename Op, typename Reset>
+void benchmark_kernel(const char *name, int ops_per_chunk, Op op, Reset reset)
+{
+    srand(BENCHMARK_SEED);
+    rand_engine.seed(BENCHMARK_SEED);
+    reset_perf_counters();
+
+    long long op_count = 0;
+    long long elapsed_ns = 0;
+    while (elapsed_ns < BENCHMARK_MIN_MILLISECONDS * 1000000LL)
+    {
+        reset();
+
+        start_perf_counters();
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < ops_per_chunk; i++)
+            op();
+        auto end = chrono::steady_clock::now();
+        stop_perf_counters();
+
+        elapsed_ns += chrono::duration_cast<chrono::nanoseconds>(end - start).count();
+        op_count += ops_per_chunk;
+    }
+
+    double ns_per_op = (double)elapsed_ns / op_count;
+    printf("%-36s %12.1f %12.3f", name, ns_per_op, 1000.0 / ns_per_op);
+    if (global_perf_enabled)
+    {
+        long long counts[N_PERF_COUNTERS];
+        read_perf_counters(counts);
+        for (int i = 0; i < N_PERF_COUNTERS; i++)
+            printf(" %12.1f", (double)counts[i] / op_count);
+    }
+    printf("\n");
+}
+
+template <typename Op> void benchmark_kernel(const char *name, Op op)
+{
+    benchmark_kernel(name, BENCHMARK_OPS_PER_CHUNK, op, [] {});
+}
+
+/* --- KERNELS --- */
+
+void benchmark_instance(const string &input)
+{
+    // parse_stdin() reads the instance from cin
+    streambuf *cin_buffer = cin.rdbuf();
+    {
+        istringstream input_stream(input);
+        cin.rdbuf(input_stream.rdbuf());
+        parse_stdin();
+    }
+    init_distances();
+
+    srand(BENCHMARK_SEED);
+    rand_engine.seed(BENCHMARK_SEED);
+
+    static Entity source_entity;
+    static Entity entity;
+    init_entity(&source_entity);
+
+    Entity source_population[N_ENTITIES];
+    Entity population[N_ENTITIES];
+    for (int i = 0; i < N_ENTITIES; i++)
+        init_entity(&source_population[i]);
+
+    int source_ride_count = get_entity_ride_count(&source_entity);
+    printf(
+        "\n%d customers | %d rides | fitness %d\n", global_customer_count, source_ride_count,
+        compute_fitness(&source_entity)
+    );
+    print_benchmark_header();
+
+    auto reset_entity = [&] { memcpy(&entity, &source_entity, sizeof(Entity)); };
+
+    benchmark_kernel(
+        "parse_stdin()", 16,
+        [&]
+        {
+            istringstream input_stream(input);
+            cin.rdbuf(input_stream.rdbuf());
+            parse_stdin();
+        },
+        [] {}
+    );
+    cin.rdbuf(cin_buffer);
+
+    benchmark_kernel("init_entity()", [&] { init_entity(&entity); });
+
+    int ride_i = 0;
+    benchmark_kernel(
+        "compute_ride_fitness()",
+        [&]
+        {
+            benchmark_sink += compute_ride_fitness(get_entity_ride(&source_entity, ride_i));
+            ride_i = ride_i + 1 == source_ride_count ? 0 : ride_i + 1;
+        }
+    );
+
+    benchmark_kernel("compute_fitness()", [&] { benchmark_sink += compute_fitness(&source_entity); }
+    );
+
+    benchmark_kernel(
+        "select_next_generation_entities()", 1,
+        [&] { select_next_generation_entities(population); },
+        [&] { memcpy(population, source_population, sizeof(Entity) * N_ENTITIES); }
+    );
+
+    benchmark_kernel(
+        "switch_customers()", BENCHMARK_OPS_PER_CHUNK, [&] { switch_customers(&entity); },
+        reset_entity
+    );
+
+    benchmark_kernel(
+        "move_customer()", BENCHMARK_OPS_PER_CHUNK, [&] { move_customer(&entity); }, reset_entity
+    );
+
+    // Every call adds a ride, so chunks stop before running out of rides
+    int create_ride_ops_per_chunk = ASSUMING_N_RIDE_PER_ENTITY - source_ride_count;
+    if (create_ride_ops_per_chunk > 0)
+        benchmark_kernel(
+            "create_ride_with_random_customer()", create_ride_ops_per_chunk,
+            [&] { create_ride_with_random_customer(&entity); }, reset_entity
+        );
+
+    // Customers that fit nowhere leave the entity incomplete, so it is reset then
+    benchmark_kernel(
+        "ruin_and_recreate()", BENCHMARK_OPS_PER_CHUNK,
+        [&]
+        {
+            int delta = ruin_and_recreate(&entity);
+            if (delta == INT_MAX)
+                reset_entity();
+            else
+                benchmark_sink += delta;
+        },
+        reset_entity
+    );
+
+    double temperature = SA_START_TEMPERATURE_RATIO * compute_fitness(&source_entity) /
+                         (global_customer_count + source_ride_count);
+    benchmark_kernel(
+        "anneal_entity()", BENCHMARK_OPS_PER_CHUNK,
+        [&] { benchmark_sink += anneal_entity(&entity, temperature); }, reset_entity
+    );
+}
+
+/* --- MAIN FUNCTIONS --- */
+
+int main(int argc, char **argv)
+{
+    struct rlimit rl;
+    getrlimit(RLIMIT_STACK, &rl);
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_STACK, &rl);
+
+    for (int i = 1; i < argc; i++)
+    {
+        string argument = argv[i];
+
+        if (argument == "--perf")
+        {
+            global_perf_enabled = init_perf_counters();
+            continue;
+        }
+
+        ifstream file(argument);
+        if (!file)
+        {
+            fprintf(stderr, "main(): Cannot open %s\n", argv[i]);
+            return 1;
+        }
+        stringstream input;
+        input << file.rdbuf();
+
+        printf("\n=== %s ===", argv[i]);
+        benchmark_instance(input.str());
+    }
+}
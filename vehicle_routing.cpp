@@ -1,22 +1,39 @@
 /*
     V1.7
 
-    Genetic algorithm.
+    Genetic algorithm (Default in FINETUNE_MODE, which tunes its mutation rates).
     - Generate a random population
     - Select parents weighted by their fitness
     - Mutate : Switch two random customers
     - Mutate : Move a customer from a ride to insert it in another ride (Can remove a ride)
     - Mutate : Create a ride with a random customer from another ride
+    - Mutate : Ruin 10-30% of the customers and recreate them with regret-k insertions
+
+    Simulated annealing (Default below DECOMPOSITION_MIN_CUSTOMERS customers or on one core).
+    - Mutate a single entity with the same moves, weighted by the mutation rates
+    - Evaluate moves with a fitness delta, apply them only once accepted
+
+    Decomposition (Default from DECOMPOSITION_MIN_CUSTOMERS customers on several cores).
+    - Split customers in sectors by polar angle around the depot
+    - Solve each sector with SECTOR_ENGINE in its own process, then stitch their rides together
+    - Rotate sector boundaries every round, keeping rides whole
+
+    Snapshots (--snapshot=path to write, --resume=path to read).
+    - Written every SNAPSHOT_INTERVAL_MILLISECONDS from a forked process
+    - Header, rand_engine state, then one giant tour of customer ids per entity
 */
 
 #include <cstdint>
 
-#define CG_MODE       1
-#define DEBUG_MODE    2
-#define FINETUNE_MODE 3
-#define CURRENT_MODE  CG_MODE
+#define CG_MODE        1
+#define DEBUG_MODE     2
+#define FINETUNE_MODE  3
+#define BENCHMARK_MODE 4 // Set by benchmarks/kernels_benchmark.cpp, which has its own main()
+#ifndef CURRENT_MODE
+#define CURRENT_MODE CG_MODE
 // #define CURRENT_MODE  DEBUG_MODE
 // #define CURRENT_MODE FINETUNE_MODE
+#endif
 
 /* --- GENETIC ALGORITHM CONSTANTS --- */
 
@@ -25,11 +42,61 @@ constexpr int N_GENERATION = INT32_MAX;
 constexpr int N_ALLOWED_MILLISECONDS = 9000;
 
 constexpr int ASSUMING_N_CUSTOMER_PER_RIDE = 40;
-constexpr int ASSUMING_N_RIDE_PER_ENTITY = 40;
+constexpr int ASSUMING_N_RIDE_PER_ENTITY = 250;
+// init_entity() packs shuffled customers ride after ride, which takes up to about 1.4 times the
+// minimum ride count, so instances are rejected above this share of ASSUMING_N_RIDE_PER_ENTITY
+constexpr int ASSUMING_RIDE_PACKING_PERCENT = 150;
 
 int MR_SWITCH_CUSTOMERS = 6;
 int MR_MOVE_CUSTOMER = 13;
 int MR_CREATE_RIDE = 3;
+int MR_RUIN_RECREATE = 1;
+
+/* --- RUIN AND RECREATE CONSTANTS --- */
+
+constexpr int RR_MIN_RUIN_PERCENT = 10;
+constexpr int RR_MAX_RUIN_PERCENT = 30;
+constexpr int RR_MAX_STRING_LENGTH = 10;
+constexpr int RR_MAX_REGRET_K = 3; // Recreate with regret-k insertion, k = 1 being greedy
+
+/* --- SIMULATED ANNEALING CONSTANTS --- */
+
+// Mutation rates above are reused as relative move weights, except for ruin and recreate which
+// costs hundreds of cheap moves and runs once every SA_RUIN_RECREATE_PERIOD moves on average
+constexpr double SA_START_TEMPERATURE_RATIO = 0.5;
+constexpr double SA_END_TEMPERATURE_RATIO = 0.005;
+// Sectors after the first round and resumed runs start from a good entity, which a start at
+// SA_START_TEMPERATURE_RATIO would undo before cooling down again
+constexpr double SA_WARM_START_TEMPERATURE_RATIO = 0.02;
+constexpr int    SA_MOVES_PER_TEMPERATURE = 1024;
+constexpr int    SA_RUIN_RECREATE_PERIOD = 512;
+
+/* --- ENGINE SELECTION --- */
+
+#define AUTO_ENGINE          0 // See choose_engine()
+#define GA_ENGINE            1
+#define SA_ENGINE            2
+#define DECOMPOSITION_ENGINE 3 // Sectors solved by GA_ENGINE or SA_ENGINE in parallel processes
+
+// Overridden with --engine=auto|ga|sa|decomposition
+int ENGINE = CURRENT_MODE == FINETUNE_MODE ? GA_ENGINE : AUTO_ENGINE;
+int SECTOR_ENGINE = SA_ENGINE; // Overridden with --sector-engine=ga|sa
+
+/* --- DECOMPOSITION CONSTANTS --- */
+
+constexpr int DECOMPOSITION_MIN_CUSTOMERS = 200; // AUTO_ENGINE threshold, needs several cores
+constexpr int DECOMPOSITION_MIN_SECTOR_CUSTOMERS = 25;
+constexpr int DECOMPOSITION_ROUNDS = 6; // Sector boundaries rotate of half a sector every round
+
+/* --- SNAPSHOT CONSTANTS --- */
+
+constexpr char SNAPSHOT_MAGIC[4] = {'V', 'R', 'P', 'S'};
+constexpr int  SNAPSHOT_VERSION = 2;
+constexpr int  SNAPSHOT_MAX_ENTITIES = 1024; // Larger entity counts are rejected when read
+constexpr int  SNAPSHOT_INTERVAL_MILLISECONDS = 1000;
+
+const char *global_snapshot_path = nullptr; // Written periodically with --snapshot=path
+const char *global_resume_path = nullptr;   // Read before solving with --resume=path
 
 #undef _GLIBCXX_DEBUG
 #pragma GCC optimize("Ofast,unroll-loops,omit-frame-pointer,inline")
@@ -42,10 +109,16 @@ int MR_CREATE_RIDE = 3;
 #include <chrono>
 #include <climits>
 #include <cstring>
+#include <fcntl.h>
 #include <iostream>
 #include <random> // for std::mt19937 and std::random_device
+#include <sstream>
 #include <string>
+#include <sys/mman.h>
 #include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
 using namespace std;
 
 // Setup random engine
@@ -62,7 +135,7 @@ struct Location
         int demand; // The demand
 };
 
-constexpr int MAX_CUSTOMERS = 199;
+constexpr int MAX_CUSTOMERS = 1999;
 int           global_customer_count;
 int           global_customer_ids[MAX_CUSTOMERS]; // Customers and locations are the same
 int           global_location_count;
@@ -166,6 +239,13 @@ int count_customer_locations(Entity *entity)
     return count;
 }
 
+// Copy only the rides in use, the rest of the destination is left as is
+void copy_entity(Entity *dst, Entity *src)
+{
+    set_entity_ride_count(dst, get_entity_ride_count(src));
+    memcpy(dst->rides, src->rides, sizeof(Ride) * get_entity_ride_count(src));
+}
+
 void remove_ride_from_entity(Entity *entity, int ride_index)
 {
     // fprintf(
@@ -244,6 +324,14 @@ bool can_customer_be_added_to_ride(Ride *ride, Location *customer_loc)
     return get_ride_capacity_left(ride) >= get_location_demand(customer_loc);
 }
 
+// The depot stands before the first customer and after the last one
+Location *get_ride_location_or_depot(Ride *ride, int index)
+{
+    if (index < 0 || index >= get_ride_customer_served(ride))
+        return global_depot_location;
+    return get_ride_customer_location(ride, index);
+}
+
 string create_entity_string(Entity *entity)
 {
     string str = "";
@@ -308,9 +396,20 @@ void init_entity(Entity *entity)
 
         Ride *ride = get_entity_ride(entity, ride_index);
 
-        // Verify current ride demand and customer one don't exceed vehicle capacity
-        if (ride_demand + cust_demand > global_vehicle_capacity)
+        // Verify current ride demand and customer one don't exceed vehicle capacity, nor the
+        // customers a ride can hold
+        if (ride_demand + cust_demand > global_vehicle_capacity ||
+            ride_customer_count == ASSUMING_N_CUSTOMER_PER_RIDE)
         {
+            if (ride_index + 1 == ASSUMING_N_RIDE_PER_ENTITY)
+            {
+                fprintf(
+                    stderr, "init_entity(): More than ASSUMING_N_RIDE_PER_ENTITY %d rides\n",
+                    ASSUMING_N_RIDE_PER_ENTITY
+                );
+                exit(0);
+            }
+
             // Set current ride final demand before going next
             set_ride_capacity_left(ride, global_vehicle_capacity - ride_demand);
             set_ride_customer_served(ride, ride_customer_count);
@@ -388,6 +487,44 @@ int euclidienne_distance(Location *loc1, Location *loc2)
     );
 }
 
+// Distances between every pair of locations, global_location_count per row so small instances
+// stay packed in cache
+int global_distances[(MAX_CUSTOMERS + 1) * (MAX_CUSTOMERS + 1)];
+// Customer ids sorted from the nearest to the farthest of each location, one row per location
+int global_nearest_customer_ids[(MAX_CUSTOMERS + 1) * MAX_CUSTOMERS];
+// Customers of the whole instance, which sectors solved alone only use a part of
+int global_nearest_customer_count = 0;
+
+int *get_nearest_customer_ids(int location_id)
+{
+    return &global_nearest_customer_ids[location_id * global_nearest_customer_count];
+}
+
+void init_distances()
+{
+    for (int i = 0; i < global_location_count; i++)
+        for (int j = 0; j < global_location_count; j++)
+            global_distances[i * global_location_count + j] =
+                euclidienne_distance(&global_locations[i], &global_locations[j]);
+
+    global_nearest_customer_count = global_customer_count;
+    for (int i = 0; i < global_location_count; i++)
+    {
+        int *distances = &global_distances[i * global_location_count];
+        int *nearest_ids = get_nearest_customer_ids(i);
+        memcpy(nearest_ids, global_customer_ids, sizeof(int) * global_nearest_customer_count);
+        sort(
+            nearest_ids, nearest_ids + global_nearest_customer_count,
+            [distances](int id1, int id2) { return distances[id1] < distances[id2]; }
+        );
+    }
+}
+
+int get_distance(Location *loc1, Location *loc2)
+{
+    return global_distances[get_location_id(loc1) * global_location_count + get_location_id(loc2)];
+}
+
 int compute_ride_fitness(Ride *ride)
 {
     int fitness = 0;
@@ -474,51 +611,58 @@ void select_next_generation_entities(Entity *population)
             index++;
 
         // Keep the selected entity in the new population
-        memcpy(&new_population[i], &population[index], sizeof(Entity));
+        copy_entity(&new_population[i], &population[index]);
     }
 
-    memcpy(population, new_population, sizeof(Entity) * N_ENTITIES);
+    for (int i = 0; i < N_ENTITIES; i++)
+        copy_entity(&population[i], &new_population[i]);
 }
 
 /* --- GENETIC ALGORITHM - CROSSOVER --- */
 
 /* --- GENETIC ALGORITHM - MUTATION --- */
 
-void switch_customers(Entity *entity)
+bool switch_customers_at(Ride *ride1, int customer_i1, Ride *ride2, int customer_i2)
 {
-    int rnd_ride_i1 = rand() % get_entity_ride_count(entity);
-    int rnd_ride_i2 = rand() % get_entity_ride_count(entity);
-
-    Ride *ride1 = get_entity_ride(entity, rnd_ride_i1);
-    Ride *ride2 = get_entity_ride(entity, rnd_ride_i2);
-
-    int rnd_customer_i1 = rand() % get_ride_customer_served(ride1);
-    int rnd_customer_i2 = rand() % get_ride_customer_served(ride2);
-
-    Location *customer1 = get_ride_customer_location(ride1, rnd_customer_i1);
-    Location *customer2 = get_ride_customer_location(ride2, rnd_customer_i2);
+    Location *customer1 = get_ride_customer_location(ride1, customer_i1);
+    Location *customer2 = get_ride_customer_location(ride2, customer_i2);
 
     // Moving customer within the same ride doesn't require capacity checks
-    if (rnd_ride_i1 != rnd_ride_i2)
+    if (ride1 != ride2)
     {
         // Verify rides can accept the other customer instead
         int new_ride1_capacity = get_ride_capacity_left(ride1) + get_location_demand(customer1) -
                                  get_location_demand(customer2);
         if (new_ride1_capacity < 0)
-            return;
+            return false;
 
         // Verify rides can accept the other customer instead
         int new_ride2_capacity = get_ride_capacity_left(ride2) + get_location_demand(customer2) -
                                  get_location_demand(customer1);
         if (new_ride2_capacity < 0)
-            return;
+            return false;
 
         set_ride_capacity_left(ride1, new_ride1_capacity);
         set_ride_capacity_left(ride2, new_ride2_capacity);
     }
 
-    set_ride_customer_location(ride1, rnd_customer_i1, customer2);
-    set_ride_customer_location(ride2, rnd_customer_i2, customer1);
+    set_ride_customer_location(ride1, customer_i1, customer2);
+    set_ride_customer_location(ride2, customer_i2, customer1);
+    return true;
+}
+
+void switch_customers(Entity *entity)
+{
+    int rnd_ride_i1 = rand() % get_entity_ride_count(entity);
+    int rnd_ride_i2 = rand() % get_entity_ride_count(entity);
+
+    Ride *ride1 = get_entity_ride(entity, rnd_ride_i1);
+    Ride *ride2 = get_entity_ride(entity, rnd_ride_i2);
+
+    int rnd_customer_i1 = rand() % get_ride_customer_served(ride1);
+    int rnd_customer_i2 = rand() % get_ride_customer_served(ride2);
+
+    switch_customers_at(ride1, rnd_customer_i1, ride2, rnd_customer_i2);
 
     if (count_customer_locations(entity) != global_customer_count)
     {
@@ -532,6 +676,29 @@ void switch_customers(Entity *entity)
     }
 }
 
+// Capacity and empty ride checks are up to the caller
+void move_customer_at(
+    Entity *entity,
+    int     ride_i_src,
+    int     customer_i_src,
+    int     ride_i_dst,
+    int     customer_i_dst
+)
+{
+    Ride     *ride_src = get_entity_ride(entity, ride_i_src);
+    Ride     *ride_dst = get_entity_ride(entity, ride_i_dst);
+    Location *customer_to_move = get_ride_customer_location(ride_src, customer_i_src);
+
+    add_customer_to_ride(ride_dst, customer_i_dst, customer_to_move);
+
+    // If the rides are the same and the dst index is before the src index, that means the src
+    // customer has been shifted of 1 place due to the dst insertion.
+    if (ride_i_dst == ride_i_src && customer_i_dst < customer_i_src)
+        customer_i_src++;
+
+    remove_customer_from_ride(entity, ride_i_src, ride_src, customer_i_src);
+}
+
 void move_customer(Entity *entity)
 {
     // Choose 2 random rides
@@ -552,16 +719,15 @@ void move_customer(Entity *entity)
         if (rnd_ride_i_dst == rnd_ride_i_src && get_ride_customer_served(ride_src) - 1 == 0)
             return;
 
+        // The customer is inserted before being removed, so the destination needs a free slot
+        if (get_ride_customer_served(ride_dst) == ASSUMING_N_CUSTOMER_PER_RIDE)
+            return;
+
         // Choose a random position to insert it in the destination ride
         int rnd_customer_i_dst = rand() % get_ride_customer_served(ride_dst);
-        add_customer_to_ride(ride_dst, rnd_customer_i_dst, customer_to_move);
-
-        // If the rides are the same and the dst index is before the src index, that means the src
-        // customer has been shifted of 1 place due to the dst insertion.
-        if (rnd_ride_i_dst == rnd_ride_i_src && rnd_customer_i_dst < rnd_customer_i_src)
-            rnd_customer_i_src++;
-
-        remove_customer_from_ride(entity, rnd_ride_i_src, ride_src, rnd_customer_i_src);
+        move_customer_at(
+            entity, rnd_ride_i_src, rnd_customer_i_src, rnd_ride_i_dst, rnd_customer_i_dst
+        );
     }
 
     if (count_customer_locations(entity) != global_customer_count)
@@ -576,8 +742,20 @@ void move_customer(Entity *entity)
     }
 }
 
+void create_ride_with_customer_at(Entity *entity, int ride_i_src, int customer_i_src)
+{
+    Ride     *ride_src = get_entity_ride(entity, ride_i_src);
+    Location *customer_to_move = get_ride_customer_location(ride_src, customer_i_src);
+
+    remove_customer_from_ride(entity, ride_i_src, ride_src, customer_i_src);
+    create_ride_to_entity(entity, customer_to_move);
+}
+
 void create_ride_with_random_customer(Entity *entity)
 {
+    if (get_entity_ride_count(entity) == ASSUMING_N_RIDE_PER_ENTITY)
+        return;
+
     // Choose a random ride to remove a customer from
     int   rnd_ride_i_src = rand() % get_entity_ride_count(entity);
     Ride *ride_src = get_entity_ride(entity, rnd_ride_i_src);
@@ -589,11 +767,8 @@ void create_ride_with_random_customer(Entity *entity)
     }
 
     // Choose a random customer to move
-    int       rnd_customer_i_src = rand() % get_ride_customer_served(ride_src);
-    Location *customer_to_move = get_ride_customer_location(ride_src, rnd_customer_i_src);
-
-    remove_customer_from_ride(entity, rnd_ride_i_src, ride_src, rnd_customer_i_src);
-    create_ride_to_entity(entity, customer_to_move);
+    int rnd_customer_i_src = rand() % get_ride_customer_served(ride_src);
+    create_ride_with_customer_at(entity, rnd_ride_i_src, rnd_customer_i_src);
 
     if (count_customer_locations(entity) != global_customer_count)
     {
@@ -607,6 +782,313 @@ void create_ride_with_random_customer(Entity *entity)
     }
 }
 
+/* --- GENETIC ALGORITHM - MUTATION - RUIN --- */
+
+#define RANDOM_RUIN  0
+#define CLUSTER_RUIN 1
+#define STRING_RUIN  2
+
+// Ride index and position of every customer served by the entity, -1 for others
+int global_customer_ride_i[MAX_CUSTOMERS + 1];
+int global_customer_position[MAX_CUSTOMERS + 1];
+
+void locate_customers(Entity *entity)
+{
+    memset(global_customer_ride_i, -1, sizeof(int) * global_location_count);
+    for (int r = 0; r < get_entity_ride_count(entity); r++)
+    {
+        Ride *ride = get_entity_ride(entity, r);
+        for (int i = 0; i < get_ride_customer_served(ride); i++)
+        {
+            int id = get_location_id(get_ride_customer_location(ride, i));
+            global_customer_ride_i[id] = r;
+            global_customer_position[id] = i;
+        }
+    }
+}
+
+// Pick strings of customers in the rides of seed_id neighbours, one string per ride. Neighbours
+// outside of the entity are skipped.
+void pick_string_customers(Entity *entity, int seed_id, bool *removed, int target_count)
+{
+    bool ride_ruined[ASSUMING_N_RIDE_PER_ENTITY] = {};
+    int  removed_count = 0;
+
+    for (int n = 0; n < global_nearest_customer_count && removed_count < target_count; n++)
+    {
+        int id = get_nearest_customer_ids(seed_id)[n];
+        int ride_i = global_customer_ride_i[id];
+        if (ride_i < 0 || removed[id] || ride_ruined[ride_i])
+            continue;
+
+        // Cut a string of customers containing this one
+        Ride *ride = get_entity_ride(entity, ride_i);
+        int   length = min(1 + rand() % RR_MAX_STRING_LENGTH, get_ride_customer_served(ride));
+        int   first = global_customer_position[id] - rand() % length;
+        first = max(0, min(first, get_ride_customer_served(ride) - length));
+
+        for (int i = first; i < first + length && removed_count < target_count; i++)
+        {
+            int string_id = get_location_id(get_ride_customer_location(ride, i));
+            if (!removed[string_id])
+            {
+                removed[string_id] = true;
+                removed_count++;
+            }
+        }
+        ride_ruined[ride_i] = true;
+    }
+}
+
+// Remove customers from the entity, return the fitness delta
+int ruin_entity(Entity *entity, int *removed_ids, int removed_count)
+{
+    bool removed[MAX_CUSTOMERS + 1] = {};
+    for (int i = 0; i < removed_count; i++)
+        removed[removed_ids[i]] = true;
+
+    int delta = 0;
+    for (int r = get_entity_ride_count(entity) - 1; r >= 0; r--)
+    {
+        Ride *ride = get_entity_ride(entity, r);
+        int   served = get_ride_customer_served(ride);
+
+        // Compact the ride over its removed customers. Each run of removed customers replaces
+        // its path from the last kept location with a direct edge to the next one, the depot
+        // closing the ride.
+        Location *kept = global_depot_location; // Last kept location
+        Location *last = global_depot_location; // Last location, kept or removed
+        int       removed_length = 0;           // Path length from kept to last
+        int       kept_count = 0;
+        for (int i = 0; i <= served; i++)
+        {
+            Location *location = get_ride_location_or_depot(ride, i);
+            if (i < served && removed[get_location_id(location)])
+            {
+                set_ride_capacity_left(
+                    ride, get_ride_capacity_left(ride) + get_location_demand(location)
+                );
+                removed_length += get_distance(last, location);
+                last = location;
+                continue;
+            }
+
+            if (last != kept)
+                delta += get_distance(kept, location) - removed_length -
+                         get_distance(last, location);
+            if (i < served)
+                set_ride_customer_location(ride, kept_count++, location);
+            kept = location;
+            last = location;
+            removed_length = 0;
+        }
+
+        if (kept_count == served)
+            continue;
+
+        set_ride_customer_served(ride, kept_count);
+
+        if (kept_count == 0)
+            remove_ride_from_entity(entity, r);
+    }
+
+    return delta;
+}
+
+// Pick 10-30% of the customers at random, by spatial cluster, or by strings of neighbours
+int pick_ruined_customers(Entity *entity, int *removed_ids)
+{
+    int ruin_percent =
+        RR_MIN_RUIN_PERCENT + rand() % (RR_MAX_RUIN_PERCENT - RR_MIN_RUIN_PERCENT + 1);
+    int target_count = max(1, global_customer_count * ruin_percent / 100);
+
+    bool removed[MAX_CUSTOMERS + 1] = {};
+    int  seed_id = global_customer_ids[rand() % global_customer_count];
+    int  strategy = rand() % 3;
+
+    locate_customers(entity);
+    if (strategy == STRING_RUIN)
+        pick_string_customers(entity, seed_id, removed, target_count);
+    else
+    {
+        // Nearest lists cover the whole instance, where a sector keeps only some customers
+        int pick_count =
+            strategy == CLUSTER_RUIN ? global_nearest_customer_count : global_customer_count;
+        int removed_count = 0;
+        for (int n = 0; n < pick_count && removed_count < target_count; n++)
+        {
+            int id = strategy == CLUSTER_RUIN
+                         ? get_nearest_customer_ids(seed_id)[n]
+                         : global_customer_ids[rand() % global_customer_count];
+            if (global_customer_ride_i[id] < 0 || removed[id])
+                continue;
+
+            removed[id] = true;
+            removed_count++;
+        }
+    }
+
+    // Random picks can collide, so the count comes from the flags
+    int removed_count = 0;
+    for (int i = 0; i < global_customer_count; i++)
+        if (removed[global_customer_ids[i]])
+            removed_ids[removed_count++] = global_customer_ids[i];
+
+    return removed_count;
+}
+
+/* --- GENETIC ALGORITHM - MUTATION - RECREATE --- */
+
+struct Insertion
+{
+        int cost;     // Fitness delta of the insertion, INT_MAX if the ride cannot take it
+        int position; // Index in the ride where to insert
+};
+
+// Cheapest insertion of every customer in every ride, only updated for the rides that changed
+Insertion global_insertions[MAX_CUSTOMERS + 1][ASSUMING_N_RIDE_PER_ENTITY];
+
+Insertion compute_cheapest_insertion(Ride *ride, Location *customer)
+{
+    Insertion insertion = {INT_MAX, 0};
+    if (!can_customer_be_added_to_ride(ride, customer) ||
+        get_ride_customer_served(ride) == ASSUMING_N_CUSTOMER_PER_RIDE)
+        return insertion;
+
+    for (int i = 0; i <= get_ride_customer_served(ride); i++)
+    {
+        Location *prev = get_ride_location_or_depot(ride, i - 1);
+        Location *next = get_ride_location_or_depot(ride, i);
+        int       cost =
+            get_distance(prev, customer) + get_distance(customer, next) - get_distance(prev, next);
+        if (cost < insertion.cost)
+            insertion = {cost, i};
+    }
+
+    return insertion;
+}
+
+void update_insertions(Entity *entity, int ride_i, int *customer_ids, int customer_count)
+{
+    Ride *ride = get_entity_ride(entity, ride_i);
+    for (int i = 0; i < customer_count; i++)
+        global_insertions[customer_ids[i]][ride_i] =
+            compute_cheapest_insertion(ride, &global_locations[customer_ids[i]]);
+}
+
+// Insert customers back where regret is the highest first, return the fitness delta or INT_MAX
+// if a customer fits nowhere
+int recreate_entity(Entity *entity, int *customer_ids, int customer_count, int regret_k)
+{
+    for (int r = 0; r < get_entity_ride_count(entity); r++)
+        update_insertions(entity, r, customer_ids, customer_count);
+
+    int delta = 0;
+    while (customer_count > 0)
+    {
+        int  ride_count = get_entity_ride_count(entity);
+        bool can_create_ride = ride_count < ASSUMING_N_RIDE_PER_ENTITY;
+
+        int best_i = -1;
+        int best_ride_i = -1;
+        int best_cost = INT_MAX;
+        int best_regret = -1;
+        for (int i = 0; i < customer_count; i++)
+        {
+            Location *customer = &global_locations[customer_ids[i]];
+
+            // k cheapest insertions, a new ride being one more option
+            int costs[RR_MAX_REGRET_K];
+            int ride_is[RR_MAX_REGRET_K];
+            for (int k = 0; k < regret_k; k++)
+                costs[k] = INT_MAX;
+
+            for (int r = 0; r <= ride_count; r++)
+            {
+                int cost;
+                if (r < ride_count)
+                    cost = global_insertions[customer_ids[i]][r].cost;
+                else
+                    cost = can_create_ride ? 2 * get_distance(global_depot_location, customer)
+                                           : INT_MAX;
+
+                for (int k = 0; k < regret_k; k++)
+                {
+                    if (cost < costs[k])
+                    {
+                        for (int j = regret_k - 1; j > k; j--)
+                        {
+                            costs[j] = costs[j - 1];
+                            ride_is[j] = ride_is[j - 1];
+                        }
+                        costs[k] = cost;
+                        ride_is[k] = r;
+                        break;
+                    }
+                }
+            }
+
+            if (costs[0] == INT_MAX)
+                return INT_MAX;
+
+            // Customers with few options get the highest regret
+            int regret = 0;
+            for (int k = 1; k < regret_k; k++)
+                regret += costs[k] == INT_MAX ? INT_MAX / RR_MAX_REGRET_K : costs[k] - costs[0];
+
+            if (regret > best_regret || (regret == best_regret && costs[0] < best_cost))
+            {
+                best_i = i;
+                best_ride_i = ride_is[0];
+                best_cost = costs[0];
+                best_regret = regret;
+            }
+        }
+
+        Location *customer = &global_locations[customer_ids[best_i]];
+        if (best_ride_i == ride_count)
+            create_ride_to_entity(entity, customer);
+        else
+            add_customer_to_ride(
+                get_entity_ride(entity, best_ride_i),
+                global_insertions[customer_ids[best_i]][best_ride_i].position, customer
+            );
+        delta += best_cost;
+
+        customer_ids[best_i] = customer_ids[--customer_count];
+        update_insertions(entity, best_ride_i, customer_ids, customer_count);
+    }
+
+    return delta;
+}
+
+// Return the fitness delta, or INT_MAX if ruined customers cannot be reinserted, in which case
+// the entity misses some customers and the caller has to restore it
+int ruin_and_recreate(Entity *entity)
+{
+    int removed_ids[MAX_CUSTOMERS];
+    int removed_count = pick_ruined_customers(entity, removed_ids);
+
+    int regret_k = 1 + rand() % RR_MAX_REGRET_K;
+    int ruin_delta = ruin_entity(entity, removed_ids, removed_count);
+    int recreate_delta = recreate_entity(entity, removed_ids, removed_count, regret_k);
+    if (recreate_delta == INT_MAX)
+        return INT_MAX;
+
+    if (count_customer_locations(entity) != global_customer_count)
+    {
+        fprintf(
+            stderr,
+            "ruin_and_recreate(): count_customer_locations() %d != "
+            "global_customer_count %d\n",
+            count_customer_locations(entity), global_customer_count
+        );
+        exit(0);
+    }
+
+    return ruin_delta + recreate_delta;
+}
+
 void mutate_entity(Entity *entity)
 {
     int rnd_number = rand() % 100;
@@ -620,6 +1102,15 @@ void mutate_entity(Entity *entity)
     rnd_number = rand() % 100;
     if (rnd_number < MR_CREATE_RIDE)
         create_ride_with_random_customer(entity);
+
+    rnd_number = rand() % 100;
+    if (rnd_number < MR_RUIN_RECREATE)
+    {
+        Entity backup;
+        copy_entity(&backup, entity);
+        if (ruin_and_recreate(entity) == INT_MAX)
+            copy_entity(entity, &backup);
+    }
 }
 
 void mutate_population(Entity *population)
@@ -628,100 +1119,504 @@ void mutate_population(Entity *population)
         mutate_entity(&population[i]);
 }
 
-/* --- MAIN FUNCTIONS --- */
+/* --- SIMULATED ANNEALING - DELTA EVALUATION --- */
 
-void parse_stdin()
+int compute_switch_customers_delta(
+    Entity *entity,
+    int     ride_i1,
+    int     customer_i1,
+    int     ride_i2,
+    int     customer_i2
+)
 {
-    if (CURRENT_MODE == FINETUNE_MODE)
+    Ride *ride1 = get_entity_ride(entity, ride_i1);
+    Ride *ride2 = get_entity_ride(entity, ride_i2);
+
+    if (ride_i1 == ride_i2)
     {
-        int seed;
-        cin >> N_ENTITIES >> MR_SWITCH_CUSTOMERS >> MR_MOVE_CUSTOMER >> MR_CREATE_RIDE >> seed;
-        cin.ignore();
+        if (customer_i1 == customer_i2)
+            return 0;
 
-        std::srand(seed);
+        // Neighbour customers share an edge, which keeps the same length once reversed
+        if (abs(customer_i1 - customer_i2) == 1)
+        {
+            int       first_i = min(customer_i1, customer_i2);
+            Location *prev = get_ride_location_or_depot(ride1, first_i - 1);
+            Location *first = get_ride_customer_location(ride1, first_i);
+            Location *second = get_ride_customer_location(ride1, first_i + 1);
+            Location *next = get_ride_location_or_depot(ride1, first_i + 2);
+
+            return get_distance(prev, second) + get_distance(first, next) -
+                   get_distance(prev, first) - get_distance(second, next);
+        }
     }
 
-    cin >> global_location_count;
-    cin.ignore();
-
-    cin >> global_vehicle_capacity;
-    cin.ignore();
+    Location *customer1 = get_ride_customer_location(ride1, customer_i1);
+    Location *prev1 = get_ride_location_or_depot(ride1, customer_i1 - 1);
+    Location *next1 = get_ride_location_or_depot(ride1, customer_i1 + 1);
 
-    // cerr << global_location_count << " " << global_vehicle_capacity << endl;
-    // fprintf(
-    //     stderr, "parse_stdin: Location count: %d | Vehicle capacity: %d\n",
-    //     global_location_count, global_vehicle_capacity
-    // );
+    Location *customer2 = get_ride_customer_location(ride2, customer_i2);
+    Location *prev2 = get_ride_location_or_depot(ride2, customer_i2 - 1);
+    Location *next2 = get_ride_location_or_depot(ride2, customer_i2 + 1);
 
-    for (int i = 0; i < global_location_count; i++)
-    {
+    return get_distance(prev1, customer2) + get_distance(customer2, next1) -
+           get_distance(prev1, customer1) - get_distance(customer1, next1) +
+           get_distance(prev2, customer1) + get_distance(customer1, next2) -
+           get_distance(prev2, customer2) - get_distance(customer2, next2);
+}
 
-        int id;     // The id of the location (0 is the depot)
-        int x;      // The x coordinate of the location
-        int y;      // The y coordinate of the location
-        int demand; // The demand
-        cin >> id >> x >> y >> demand;
-        // cerr << id << " " << x << " " << y << " " << demand << endl;
+int compute_remove_customer_delta(Ride *ride, int customer_i)
+{
+    Location *customer = get_ride_customer_location(ride, customer_i);
+    Location *prev = get_ride_location_or_depot(ride, customer_i - 1);
+    Location *next = get_ride_location_or_depot(ride, customer_i + 1);
 
-        Location *location = &global_locations[i];
-        set_location_id(location, id);
-        set_location_x(location, x);
-        set_location_y(location, y);
-        set_location_demand(location, demand);
+    return get_distance(prev, next) - get_distance(prev, customer) - get_distance(customer, next);
+}
 
-        if (id != 0)
-            global_customer_ids[id - 1] = id;
+int compute_move_customer_delta(
+    Ride *ride_src,
+    int   customer_i_src,
+    Ride *ride_dst,
+    int   customer_i_dst
+)
+{
+    Location *customer = get_ride_customer_location(ride_src, customer_i_src);
 
-        cin.ignore();
+    Location *prev;
+    Location *next;
+    if (ride_src == ride_dst)
+    {
+        // Same as inserting in the ride once the customer is removed, where indexes after the
+        // source one are shifted of 1 place
+        int insert_i = customer_i_dst <= customer_i_src ? customer_i_dst : customer_i_dst - 1;
+        int prev_i = insert_i - 1;
+        int next_i = insert_i;
+        prev = get_ride_location_or_depot(ride_src, prev_i < customer_i_src ? prev_i : prev_i + 1);
+        next = get_ride_location_or_depot(ride_src, next_i < customer_i_src ? next_i : next_i + 1);
+    }
+    else
+    {
+        prev = get_ride_location_or_depot(ride_dst, customer_i_dst - 1);
+        next = get_ride_location_or_depot(ride_dst, customer_i_dst);
     }
 
-    // Depot is the first location in the list
-    global_customer_count = global_location_count - 1;
-
-    // for (int i = 0; i < global_customer_count; i++)
-    //     cerr << "Demand in location id " << i << ": " << global_customer_ids[i]
-    //          << endl; // 0 is the depot, so we skip the first custom
+    return compute_remove_customer_delta(ride_src, customer_i_src) + get_distance(prev, customer) +
+           get_distance(customer, next) - get_distance(prev, next);
+}
 
-    // cerr << "Parsed " << global_location_count << " locations" << endl;
-    // for (int i = 1; i < global_location_count; i++)
-    //     print_location(&global_locations[i]);
+int compute_create_ride_delta(Entity *entity, int ride_i_src, int customer_i_src)
+{
+    Ride     *ride_src = get_entity_ride(entity, ride_i_src);
+    Location *customer = get_ride_customer_location(ride_src, customer_i_src);
 
-    // cerr << "----------------------------------------" << endl;
-    // for (int i = 0; i < N_ENTITIES; i++)
-    //     cerr << "Entity " << i << " has " << get_entity_ride_count(population[i])
-    //          << " rides (fitness=" << compute_fitness(population[i])
-    //          << "): " << create_entity_string(population[i]) << endl;
+    return compute_remove_customer_delta(ride_src, customer_i_src) +
+           2 * get_distance(global_depot_location, customer);
 }
 
-int main()
+/* --- SIMULATED ANNEALING --- */
+
+bool accept_delta(int delta, double temperature)
 {
-    parse_stdin();
+    if (delta <= 0)
+        return true;
 
-    struct rlimit rl;
-    getrlimit(RLIMIT_STACK, &rl);
-    rl.rlim_cur = rl.rlim_max;
-    setrlimit(RLIMIT_STACK, &rl);
+    return exp(-delta / temperature) * RAND_MAX > rand();
+}
 
-    auto start = chrono::high_resolution_clock::now();
+// Draw one random move and apply it only if accepted, return the applied fitness delta
+int anneal_entity(Entity *entity, double temperature)
+{
+    int ride_count = get_entity_ride_count(entity);
+    int rnd_number = rand() % (MR_SWITCH_CUSTOMERS + MR_MOVE_CUSTOMER + MR_CREATE_RIDE);
 
-    Entity population[N_ENTITIES];
-    init_population(population);
+    if (MR_RUIN_RECREATE > 0 && rand() % SA_RUIN_RECREATE_PERIOD == 0)
+    {
+        // Ruin and recreate is only evaluated once applied, so keep a copy to revert it
+        Entity backup;
+        copy_entity(&backup, entity);
 
-    Entity *best_entity = get_best_entity(population);
-    int     best_first_fitness = compute_fitness(best_entity);
-    int     best_fitness = best_first_fitness;
+        int delta = ruin_and_recreate(entity);
+        if (delta != INT_MAX && accept_delta(delta, temperature))
+            return delta;
 
-    fprintf(
-        stderr,
-        "Starting GA with %d entities | Mutation rates: Switch c=%d%%, Move c=%d%%, Create "
-        "r=%d%%\n",
-        N_ENTITIES, MR_SWITCH_CUSTOMERS, MR_MOVE_CUSTOMER, MR_CREATE_RIDE
+        copy_entity(entity, &backup);
+    }
+    else if (rnd_number < MR_SWITCH_CUSTOMERS)
+    {
+        int ride_i1 = rand() % ride_count;
+        int ride_i2 = rand() % ride_count;
+        Ride *ride1 = get_entity_ride(entity, ride_i1);
+        Ride *ride2 = get_entity_ride(entity, ride_i2);
+        int   customer_i1 = rand() % get_ride_customer_served(ride1);
+        int   customer_i2 = rand() % get_ride_customer_served(ride2);
+
+        int delta =
+            compute_switch_customers_delta(entity, ride_i1, customer_i1, ride_i2, customer_i2);
+        if (accept_delta(delta, temperature) &&
+            switch_customers_at(ride1, customer_i1, ride2, customer_i2))
+            return delta;
+    }
+    else if (rnd_number < MR_SWITCH_CUSTOMERS + MR_MOVE_CUSTOMER)
+    {
+        int   ride_i_src = rand() % ride_count;
+        int   ride_i_dst = rand() % ride_count;
+        Ride *ride_src = get_entity_ride(entity, ride_i_src);
+        Ride *ride_dst = get_entity_ride(entity, ride_i_dst);
+
+        int       customer_i_src = rand() % get_ride_customer_served(ride_src);
+        Location *customer = get_ride_customer_location(ride_src, customer_i_src);
+
+        // The customer is inserted before being removed, so the destination needs a free slot
+        if (get_ride_customer_served(ride_dst) == ASSUMING_N_CUSTOMER_PER_RIDE)
+            return 0;
+        if (ride_i_src == ride_i_dst && get_ride_customer_served(ride_src) == 1)
+            return 0;
+        if (ride_i_src != ride_i_dst && !can_customer_be_added_to_ride(ride_dst, customer))
+            return 0;
+
+        int customer_i_dst = rand() % (get_ride_customer_served(ride_dst) + 1);
+
+        int delta = compute_move_customer_delta(ride_src, customer_i_src, ride_dst, customer_i_dst);
+        if (accept_delta(delta, temperature))
+        {
+            move_customer_at(entity, ride_i_src, customer_i_src, ride_i_dst, customer_i_dst);
+            return delta;
+        }
+    }
+    else
+    {
+        int   ride_i_src = rand() % ride_count;
+        Ride *ride_src = get_entity_ride(entity, ride_i_src);
+
+        if (ride_count == ASSUMING_N_RIDE_PER_ENTITY || get_ride_customer_served(ride_src) == 1)
+            return 0;
+
+        int customer_i_src = rand() % get_ride_customer_served(ride_src);
+
+        int delta = compute_create_ride_delta(entity, ride_i_src, customer_i_src);
+        if (accept_delta(delta, temperature))
+        {
+            create_ride_with_customer_at(entity, ride_i_src, customer_i_src);
+            return delta;
+        }
+    }
+
+    return 0;
+}
+
+/* --- SNAPSHOT --- */
+
+struct SnapshotHeader
+{
+        char     magic[4];       // SNAPSHOT_MAGIC
+        uint32_t version;        // SNAPSHOT_VERSION
+        uint64_t instance_hash;  // Snapshots only resume runs on the same instance
+        uint32_t customer_count; // Customers of the instance
+        uint32_t entity_count;   // Entities following the header, the best one first
+        uint32_t tour_length;    // Customer ids of each entity giant tour
+        uint32_t rand_engine_state[mt19937::state_size + 1]; // State words, then their index
+};
+
+// Customer ids are packed on two bytes
+typedef uint16_t TourId;
+static_assert(MAX_CUSTOMERS <= UINT16_MAX, "Giant tours need wider customer ids");
+
+pid_t global_snapshot_pid = 0; // Process still writing the last snapshot, 0 if none
+
+// FNV-1a hash of everything parsed from the instance
+uint64_t compute_instance_hash()
+{
+    uint64_t hash = 14695981039346656037ULL;
+    auto     mix = [&hash](int value)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            hash ^= (value >> (i * 8)) & 0xFF;
+            hash *= 1099511628211ULL;
+        }
+    };
+
+    mix(global_location_count);
+    mix(global_vehicle_capacity);
+    for (int i = 0; i < global_location_count; i++)
+    {
+        mix(get_location_id(&global_locations[i]));
+        mix(get_location_x(&global_locations[i]));
+        mix(get_location_y(&global_locations[i]));
+        mix(get_location_demand(&global_locations[i]));
+    }
+
+    return hash;
+}
+
+// Every customer plus one depot id per ride of the entity with the most rides
+int get_snapshot_tour_length(Entity *best_entity, Entity *entities, int entity_count)
+{
+    int ride_count = get_entity_ride_count(best_entity);
+    for (int i = 0; i < entity_count; i++)
+        ride_count = max(ride_count, get_entity_ride_count(&entities[i]));
+
+    return global_customer_count + ride_count;
+}
+
+// A tour needs at least one ride, and never more rides than customers
+bool is_snapshot_tour_length_valid(uint32_t tour_length)
+{
+    uint32_t customer_count = global_customer_count;
+    uint32_t max_ride_count = min(global_customer_count, ASSUMING_N_RIDE_PER_ENTITY);
+    return tour_length > customer_count && tour_length <= customer_count + max_ride_count;
+}
+
+// The text format of mt19937 is its state words then their index, as plain integers
+void save_rand_engine_state(uint32_t *state)
+{
+    stringstream stream;
+    stream << rand_engine;
+    for (size_t i = 0; i < mt19937::state_size + 1; i++)
+        stream >> state[i];
+}
+
+// rand() state cannot be exported, so it is reseeded from the restored rand_engine
+void restore_rand_engine_state(uint32_t *state)
+{
+    stringstream stream;
+    for (size_t i = 0; i < mt19937::state_size + 1; i++)
+        stream << state[i] << ' ';
+    stream >> rand_engine;
+
+    mt19937 seed_engine = rand_engine;
+    srand(seed_engine());
+}
+
+// Customer ids ride after ride, each ride followed by the depot id 0, padded with 0
+void pack_entity_tour(Entity *entity, TourId *tour, int tour_length)
+{
+    memset(tour, 0, sizeof(TourId) * tour_length);
+
+    int tour_i = 0;
+    for (int r = 0; r < get_entity_ride_count(entity); r++)
+    {
+        Ride *ride = get_entity_ride(entity, r);
+        for (int i = 0; i < get_ride_customer_served(ride); i++)
+            tour[tour_i++] = get_location_id(get_ride_customer_location(ride, i));
+        tour_i++;
+    }
+}
+
+// Return false if the tour does not serve every customer once within the vehicle capacity
+bool unpack_entity_tour(TourId *tour, int tour_length, Entity *entity)
+{
+    bool  served[MAX_CUSTOMERS + 1] = {};
+    Ride *ride = nullptr;
+
+    set_entity_ride_count(entity, 0);
+    for (int tour_i = 0; tour_i < tour_length; tour_i++)
+    {
+        int id = tour[tour_i];
+        if (id == 0)
+        {
+            ride = nullptr;
+            continue;
+        }
+        if (id >= global_location_count || served[id])
+            return false;
+        served[id] = true;
+
+        Location *customer = &global_locations[id];
+        if (ride == nullptr)
+        {
+            if (get_entity_ride_count(entity) == ASSUMING_N_RIDE_PER_ENTITY)
+                return false;
+            create_ride_to_entity(entity, customer);
+            ride = get_entity_ride(entity, get_entity_ride_count(entity) - 1);
+        }
+        else
+        {
+            if (!can_customer_be_added_to_ride(ride, customer) ||
+                get_ride_customer_served(ride) == ASSUMING_N_CUSTOMER_PER_RIDE)
+                return false;
+            add_customer_to_ride(ride, get_ride_customer_served(ride), customer);
+        }
+    }
+
+    return count_customer_locations(entity) == global_customer_count;
+}
+
+bool write_buffer(int fd, char *buffer, size_t size)
+{
+    size_t written_size = 0;
+    while (written_size < size)
+    {
+        ssize_t write_size = write(fd, buffer + written_size, size - written_size);
+        if (write_size <= 0)
+            return false;
+        written_size += write_size;
+    }
+    return true;
+}
+
+// Write to a temporary file first, so a killed run never leaves a truncated snapshot
+bool write_snapshot_file(Entity *best_entity, Entity *entities, int entity_count)
+{
+    int    tour_length = get_snapshot_tour_length(best_entity, entities, entity_count);
+    size_t size =
+        sizeof(SnapshotHeader) + sizeof(TourId) * (size_t)(entity_count + 1) * tour_length;
+    uint8_t buffer[size];
+
+    SnapshotHeader *header = (SnapshotHeader *)buffer;
+    memcpy(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic));
+    header->version = SNAPSHOT_VERSION;
+    header->instance_hash = compute_instance_hash();
+    header->customer_count = global_customer_count;
+    header->entity_count = entity_count + 1;
+    header->tour_length = tour_length;
+    save_rand_engine_state(header->rand_engine_state);
+
+    TourId *tours = (TourId *)(buffer + sizeof(SnapshotHeader));
+    pack_entity_tour(best_entity, tours, tour_length);
+    for (int i = 0; i < entity_count; i++)
+        pack_entity_tour(&entities[i], tours + (size_t)(i + 1) * tour_length, tour_length);
+
+    string tmp_path = string(global_snapshot_path) + ".tmp";
+    int    fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        fprintf(stderr, "write_snapshot_file(): Cannot open %s\n", tmp_path.c_str());
+        return false;
+    }
+
+    bool written = write_buffer(fd, (char *)buffer, size);
+    close(fd);
+
+    return written && rename(tmp_path.c_str(), global_snapshot_path) == 0;
+}
+
+// Write the best entity then the others from a forked process, which keeps a copy-on-write copy
+// of them while the search goes on. Skipped if the last snapshot is still being written, unless
+// wait is set.
+void write_snapshot(Entity *best_entity, Entity *entities, int entity_count, bool wait)
+{
+    if (!global_snapshot_path)
+        return;
+
+    if (global_snapshot_pid > 0)
+    {
+        if (waitpid(global_snapshot_pid, nullptr, wait ? 0 : WNOHANG) == 0)
+            return;
+        global_snapshot_pid = 0;
+    }
+
+    pid_t pid = fork();
+    if (pid == 0)
+        _exit(write_snapshot_file(best_entity, entities, entity_count) ? 0 : 1);
+
+    if (pid < 0)
+    {
+        // Processes are not available, write it from here instead
+        write_snapshot_file(best_entity, entities, entity_count);
+        return;
+    }
+
+    global_snapshot_pid = pid;
+    if (wait)
+    {
+        waitpid(pid, nullptr, 0);
+        global_snapshot_pid = 0;
+    }
+}
+
+// Map a snapshot of this instance and unpack up to max_entity_count entities, the best one first.
+// Return the number of entities read. The run goes on with the saved rand_engine state, but not
+// the rest of the search state (SA temperature, elapsed time), so it does not replay the same
+// moves as the run that wrote it.
+int read_snapshot(const char *path, Entity *entities, int max_entity_count)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        fprintf(stderr, "read_snapshot(): Cannot open %s\n", path);
+        return 0;
+    }
+
+    struct stat file_stat;
+    void       *data = MAP_FAILED;
+    if (fstat(fd, &file_stat) == 0 && (size_t)file_stat.st_size >= sizeof(SnapshotHeader))
+        data = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED)
+    {
+        fprintf(stderr, "read_snapshot(): Cannot map %s\n", path);
+        return 0;
+    }
+
+    SnapshotHeader *header = (SnapshotHeader *)data;
+    TourId         *tours = (TourId *)((uint8_t *)data + sizeof(SnapshotHeader));
+    int             entity_count = 0;
+
+    // Counts are checked before the size, so it cannot overflow
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != SNAPSHOT_VERSION || header->instance_hash != compute_instance_hash() ||
+        header->customer_count != (uint32_t)global_customer_count ||
+        header->entity_count == 0 || header->entity_count > (uint32_t)SNAPSHOT_MAX_ENTITIES ||
+        !is_snapshot_tour_length_valid(header->tour_length) ||
+        (size_t)file_stat.st_size <
+            sizeof(SnapshotHeader) + sizeof(TourId) * header->entity_count * header->tour_length)
+    {
+        fprintf(stderr, "read_snapshot(): %s is not a snapshot of this instance\n", path);
+    }
+    else
+    {
+        for (uint32_t i = 0; i < header->entity_count && entity_count < max_entity_count; i++)
+        {
+            TourId *tour = tours + (size_t)i * header->tour_length;
+            if (unpack_entity_tour(tour, header->tour_length, &entities[entity_count]))
+                entity_count++;
+            else
+                fprintf(stderr, "read_snapshot(): Entity %u of %s is invalid\n", i, path);
+        }
+
+        restore_rand_engine_state(header->rand_engine_state);
+    }
+
+    munmap(data, file_stat.st_size);
+    return entity_count;
+}
+
+/* --- ENGINES --- */
+
+// Return the number of generations, initial entities replace the first random ones
+int run_genetic_algorithm(
+    Entity                                   *best_entity,
+    chrono::high_resolution_clock::time_point start,
+    int                                       allowed_milliseconds,
+    Entity                                   *initial_entities,
+    int                                       initial_entity_count
+)
+{
+    Entity population[N_ENTITIES];
+    init_population(population);
+    for (int i = 0; i < min(initial_entity_count, N_ENTITIES); i++)
+        copy_entity(&population[i], &initial_entities[i]);
+
+    Entity *best_population_entity = get_best_entity(population);
+    int     best_first_fitness = compute_fitness(best_population_entity);
+    int     best_fitness = best_first_fitness;
+    copy_entity(best_entity, best_population_entity);
+
+    fprintf(
+        stderr,
+        "Starting GA with %d entities | Mutation rates: Switch c=%d%%, Move c=%d%%, Create "
+        "r=%d%%\n",
+        N_ENTITIES, MR_SWITCH_CUSTOMERS, MR_MOVE_CUSTOMER, MR_CREATE_RIDE
     );
 
     int  generation_count = 0;
+    int  snapshot_milliseconds = 0;
     auto end = chrono::high_resolution_clock::now();
     while (chrono::duration_cast<chrono::milliseconds>(end - start).count() <
-               N_ALLOWED_MILLISECONDS &&
+               allowed_milliseconds &&
            generation_count < N_GENERATION)
     {
         select_next_generation_entities(population);
@@ -733,10 +1628,16 @@ int main()
         if (fitness < best_fitness)
         {
             best_fitness = fitness;
-            best_entity = entity;
+            copy_entity(best_entity, entity);
         }
 
         end = chrono::high_resolution_clock::now();
+        int elapsed_milliseconds = chrono::duration_cast<chrono::milliseconds>(end - start).count();
+        if (elapsed_milliseconds - snapshot_milliseconds >= SNAPSHOT_INTERVAL_MILLISECONDS)
+        {
+            write_snapshot(best_entity, population, N_ENTITIES, false);
+            snapshot_milliseconds = elapsed_milliseconds;
+        }
         // fprintf(
         //     stderr, "Best fitness after %ldms and %d generations (of %d entities): %d -> %d\n",
         //     chrono::duration_cast<chrono::milliseconds>(end - start).count(), generation_count,
@@ -744,16 +1645,625 @@ int main()
         // );
     }
 
+    write_snapshot(best_entity, population, N_ENTITIES, true);
+
     fprintf(
         stderr, "Best fitnesses after %d generations (of %d entities): %d -> %d\n",
         generation_count, N_ENTITIES, best_first_fitness, best_fitness
     );
 
+    return generation_count;
+}
+
+// Return the number of tried moves, start from initial_entity or a random one if nullptr
+int run_simulated_annealing(
+    Entity                                   *best_entity,
+    chrono::high_resolution_clock::time_point start,
+    int                                       allowed_milliseconds,
+    Entity                                   *initial_entity
+)
+{
+    Entity entity;
+    if (initial_entity)
+        copy_entity(&entity, initial_entity);
+    else
+        init_entity(&entity);
+
+    int first_fitness = compute_fitness(&entity);
+    int fitness = first_fitness;
+    int best_fitness = first_fitness;
+    copy_entity(best_entity, &entity);
+
+    // Temperatures are relative to the mean edge length of the initial entity
+    double mean_edge =
+        (double)first_fitness / (global_customer_count + get_entity_ride_count(&entity));
+    double start_temperature =
+        (initial_entity ? SA_WARM_START_TEMPERATURE_RATIO : SA_START_TEMPERATURE_RATIO) * mean_edge;
+    double end_temperature = SA_END_TEMPERATURE_RATIO * mean_edge;
+    double temperature = start_temperature;
+
+    fprintf(
+        stderr,
+        "Starting SA with temperature %.2f -> %.2f | Move weights: Switch c=%d, Move c=%d, "
+        "Create r=%d | Ruin r=1/%d\n",
+        start_temperature, end_temperature, MR_SWITCH_CUSTOMERS, MR_MOVE_CUSTOMER, MR_CREATE_RIDE,
+        MR_RUIN_RECREATE > 0 ? SA_RUIN_RECREATE_PERIOD : 0
+    );
+
+    int move_count = 0;
+    int snapshot_milliseconds = 0;
+    while (true)
+    {
+        fitness += anneal_entity(&entity, temperature);
+        move_count++;
+
+        if (fitness < best_fitness)
+        {
+            best_fitness = fitness;
+            copy_entity(best_entity, &entity);
+        }
+
+        // Reading the clock costs more than a move, so cool down by batch of moves
+        if (move_count % SA_MOVES_PER_TEMPERATURE == 0)
+        {
+            auto end = chrono::high_resolution_clock::now();
+            int  elapsed_milliseconds =
+                chrono::duration_cast<chrono::milliseconds>(end - start).count();
+            double elapsed_ratio = (double)elapsed_milliseconds / allowed_milliseconds;
+            if (elapsed_ratio >= 1)
+                break;
+
+            if (elapsed_milliseconds - snapshot_milliseconds >= SNAPSHOT_INTERVAL_MILLISECONDS)
+            {
+                write_snapshot(best_entity, &entity, 1, false);
+                snapshot_milliseconds = elapsed_milliseconds;
+            }
+
+            temperature =
+                start_temperature * pow(end_temperature / start_temperature, elapsed_ratio);
+        }
+    }
+
+    if (CURRENT_MODE == DEBUG_MODE && compute_fitness(&entity) != fitness)
+    {
+        fprintf(
+            stderr, "run_simulated_annealing(): compute_fitness() %d != delta fitness %d\n",
+            compute_fitness(&entity), fitness
+        );
+        exit(0);
+    }
+
+    write_snapshot(best_entity, &entity, 1, true);
+
+    fprintf(
+        stderr, "Best fitnesses after %d moves: %d -> %d\n", move_count, first_fitness,
+        best_fitness
+    );
+
+    return move_count;
+}
+
+/* --- DECOMPOSITION - PARTITION --- */
+
+struct Sector
+{
+        int    customer_count;
+        int    customer_ids[MAX_CUSTOMERS];
+        Entity entity; // Rides serving the sector customers, none on the first round
+};
+
+// Polar angle around the depot, in [0, 2 * M_PI) once rotated of offset
+double get_location_angle(Location *location, double offset)
+{
+    double angle = atan2(
+        get_location_y(location) - get_location_y(global_depot_location),
+        get_location_x(location) - get_location_x(global_depot_location)
+    );
+    return fmod(angle - offset + 4 * M_PI, 2 * M_PI);
+}
+
+double get_ride_angle(Ride *ride, double offset)
+{
+    // Angle of the ride customers centroid
+    double x = 0;
+    double y = 0;
+    for (int i = 0; i < get_ride_customer_served(ride); i++)
+    {
+        x += get_location_x(get_ride_customer_location(ride, i));
+        y += get_location_y(get_ride_customer_location(ride, i));
+    }
+    x /= get_ride_customer_served(ride);
+    y /= get_ride_customer_served(ride);
+
+    double angle =
+        atan2(y - get_location_y(global_depot_location), x - get_location_x(global_depot_location));
+    return fmod(angle - offset + 4 * M_PI, 2 * M_PI);
+}
+
+void partition_customers_by_angle(Sector *sectors, int sector_count)
+{
+    int customer_ids[global_customer_count];
+    memcpy(customer_ids, global_customer_ids, sizeof(customer_ids));
+    sort(
+        customer_ids, customer_ids + global_customer_count,
+        [](int id1, int id2)
+        {
+            return get_location_angle(&global_locations[id1], 0) <
+                   get_location_angle(&global_locations[id2], 0);
+        }
+    );
+
+    for (int i = 0; i < sector_count; i++)
+    {
+        int first = i * global_customer_count / sector_count;
+        int last = (i + 1) * global_customer_count / sector_count;
+
+        sectors[i].customer_count = last - first;
+        memcpy(sectors[i].customer_ids, &customer_ids[first], sizeof(int) * (last - first));
+        set_entity_ride_count(&sectors[i].entity, 0);
+    }
+}
+
+// Keep rides whole so each sector starts from the current solution
+void partition_rides_by_angle(Entity *entity, Sector *sectors, int sector_count, double offset)
+{
+    int    ride_count = get_entity_ride_count(entity);
+    int    ride_indexes[ride_count];
+    double ride_angles[ride_count];
+    for (int i = 0; i < ride_count; i++)
+    {
+        ride_indexes[i] = i;
+        ride_angles[i] = get_ride_angle(get_entity_ride(entity, i), offset);
+    }
+    sort(
+        ride_indexes, ride_indexes + ride_count,
+        [&](int i1, int i2) { return ride_angles[i1] < ride_angles[i2]; }
+    );
+
+    for (int i = 0; i < sector_count; i++)
+    {
+        sectors[i].customer_count = 0;
+        set_entity_ride_count(&sectors[i].entity, 0);
+    }
+
+    // A ride goes to the sector holding the middle of its customers in the angle order
+    int customer_count = 0;
+    for (int i = 0; i < ride_count; i++)
+    {
+        Ride *ride = get_entity_ride(entity, ride_indexes[i]);
+        int   served = get_ride_customer_served(ride);
+
+        int middle_customer_count = customer_count + served / 2;
+        int sector_i =
+            min(sector_count - 1, middle_customer_count * sector_count / global_customer_count);
+
+        Sector *sector = &sectors[sector_i];
+        customer_count += served;
+
+        for (int j = 0; j < served; j++)
+            sector->customer_ids[sector->customer_count++] =
+                get_location_id(get_ride_customer_location(ride, j));
+
+        int sector_ride_count = get_entity_ride_count(&sector->entity);
+        memcpy(get_entity_ride(&sector->entity, sector_ride_count), ride, sizeof(Ride));
+        set_entity_ride_count(&sector->entity, sector_ride_count + 1);
+    }
+}
+
+/* --- DECOMPOSITION - SOLVING --- */
+
+// SA beats the GA on whole instances of every size up to MAX_CUSTOMERS, so the GA is only
+// picked explicitly
+int choose_engine(int customer_count)
+{
+    if (customer_count >= DECOMPOSITION_MIN_CUSTOMERS && sysconf(_SC_NPROCESSORS_ONLN) > 1)
+        return DECOMPOSITION_ENGINE;
+    return SA_ENGINE;
+}
+
+// Solve the sector as if its customers were the whole instance
+void solve_sector(Sector *sector, int allowed_milliseconds, Entity *result)
+{
+    int saved_customer_count = global_customer_count;
+    int saved_customer_ids[MAX_CUSTOMERS];
+    memcpy(saved_customer_ids, global_customer_ids, sizeof(int) * global_customer_count);
+
+    global_customer_count = sector->customer_count;
+    memcpy(global_customer_ids, sector->customer_ids, sizeof(int) * sector->customer_count);
+
+    // Snapshots are taken of the whole instance only
+    const char *saved_snapshot_path = global_snapshot_path;
+    global_snapshot_path = nullptr;
+
+    auto    start = chrono::high_resolution_clock::now();
+    Entity *initial_entity = get_entity_ride_count(&sector->entity) ? &sector->entity : nullptr;
+    if (SECTOR_ENGINE == GA_ENGINE)
+        run_genetic_algorithm(
+            result, start, allowed_milliseconds, initial_entity, initial_entity ? 1 : 0
+        );
+    else
+        run_simulated_annealing(result, start, allowed_milliseconds, initial_entity);
+
+    global_customer_count = saved_customer_count;
+    memcpy(global_customer_ids, saved_customer_ids, sizeof(int) * saved_customer_count);
+    global_snapshot_path = saved_snapshot_path;
+}
+
+bool read_entity(int fd, Entity *entity)
+{
+    char  *buffer = (char *)entity;
+    size_t read_size = 0;
+    while (read_size < sizeof(Entity))
+    {
+        ssize_t size = read(fd, buffer + read_size, sizeof(Entity) - read_size);
+        if (size <= 0)
+            return false;
+        read_size += size;
+    }
+    return true;
+}
+
+bool write_entity(int fd, Entity *entity)
+{
+    return write_buffer(fd, (char *)entity, sizeof(Entity));
+}
+
+// One forked process per sector. Locations are shared copy-on-write, so the Location pointers
+// of the entity sent back through the pipe stay valid in this process.
+void solve_sectors(Sector *sectors, int sector_count, int allowed_milliseconds, Entity *results)
+{
+    pid_t pids[sector_count];
+    int   fds[sector_count];
+
+    for (int i = 0; i < sector_count; i++)
+    {
+        pids[i] = 0;
+        if (sectors[i].customer_count == 0)
+            continue;
+
+        // Seeds come from this process so FINETUNE_MODE runs stay reproducible
+        int seed = rand();
+
+        int pipe_fds[2];
+        if (pipe(pipe_fds) == 0)
+        {
+            pids[i] = fork();
+            if (pids[i] < 0)
+            {
+                close(pipe_fds[0]);
+                close(pipe_fds[1]);
+            }
+        }
+        else
+            pids[i] = -1;
+
+        if (pids[i] == 0)
+        {
+            close(pipe_fds[0]);
+            srand(seed);
+            rand_engine.seed(seed);
+            solve_sector(&sectors[i], allowed_milliseconds, &results[i]);
+            _exit(write_entity(pipe_fds[1], &results[i]) ? 0 : 1);
+        }
+        else if (pids[i] < 0)
+        {
+            // Processes are not available, solve it here with a share of the time instead
+            srand(seed);
+            rand_engine.seed(seed);
+            solve_sector(&sectors[i], allowed_milliseconds / sector_count, &results[i]);
+        }
+        else
+        {
+            close(pipe_fds[1]);
+            fds[i] = pipe_fds[0];
+        }
+    }
+
+    for (int i = 0; i < sector_count; i++)
+    {
+        if (pids[i] <= 0)
+            continue;
+
+        bool received = read_entity(fds[i], &results[i]);
+        close(fds[i]);
+        waitpid(pids[i], nullptr, 0);
+
+        if (!received)
+        {
+            fprintf(stderr, "solve_sectors(): No entity received from sector %d\n", i);
+            exit(0);
+        }
+    }
+}
+
+// Return false if the stitched entity would have too many rides
+bool stitch_sectors(Sector *sectors, int sector_count, Entity *results, Entity *entity)
+{
+    int ride_count = 0;
+    for (int i = 0; i < sector_count; i++)
+        if (sectors[i].customer_count)
+            ride_count += get_entity_ride_count(&results[i]);
+
+    if (ride_count > ASSUMING_N_RIDE_PER_ENTITY)
+        return false;
+
+    set_entity_ride_count(entity, 0);
+    for (int i = 0; i < sector_count; i++)
+    {
+        if (sectors[i].customer_count == 0)
+            continue;
+
+        for (int r = 0; r < get_entity_ride_count(&results[i]); r++)
+        {
+            int entity_ride_count = get_entity_ride_count(entity);
+            memcpy(
+                get_entity_ride(entity, entity_ride_count), get_entity_ride(&results[i], r),
+                sizeof(Ride)
+            );
+            set_entity_ride_count(entity, entity_ride_count + 1);
+        }
+    }
+
+    if (count_customer_locations(entity) != global_customer_count)
+    {
+        fprintf(
+            stderr, "stitch_sectors(): count_customer_locations() %d != global_customer_count %d\n",
+            count_customer_locations(entity), global_customer_count
+        );
+        exit(0);
+    }
+    return true;
+}
+
+// Return the number of rounds, sectors start from initial_entity rides unless it is nullptr
+int run_decomposition(
+    Entity                                   *best_entity,
+    chrono::high_resolution_clock::time_point start,
+    Entity                                   *initial_entity
+)
+{
+    int sector_count = max(
+        2, min((int)sysconf(_SC_NPROCESSORS_ONLN),
+               global_customer_count / DECOMPOSITION_MIN_SECTOR_CUSTOMERS)
+    );
+
+    Sector sectors[sector_count];
+    Entity results[sector_count];
+
+    fprintf(
+        stderr, "Starting decomposition with %d sectors over %d rounds\n", sector_count,
+        DECOMPOSITION_ROUNDS
+    );
+
+    bool has_best_entity = initial_entity != nullptr;
+    int  first_fitness = 0;
+    int  best_fitness = 0;
+    if (has_best_entity)
+    {
+        copy_entity(best_entity, initial_entity);
+        first_fitness = compute_fitness(best_entity);
+        best_fitness = first_fitness;
+    }
+
+    int round = 0;
+    for (; round < DECOMPOSITION_ROUNDS; round++)
+    {
+        auto end = chrono::high_resolution_clock::now();
+        int elapsed_milliseconds = chrono::duration_cast<chrono::milliseconds>(end - start).count();
+        int round_milliseconds =
+            (N_ALLOWED_MILLISECONDS - elapsed_milliseconds) / (DECOMPOSITION_ROUNDS - round);
+
+        double offset = round * M_PI / sector_count;
+        if (has_best_entity)
+            partition_rides_by_angle(best_entity, sectors, sector_count, offset);
+        else
+            partition_customers_by_angle(sectors, sector_count);
+
+        solve_sectors(sectors, sector_count, round_milliseconds, results);
+
+        Entity entity;
+        if (!stitch_sectors(sectors, sector_count, results, &entity))
+        {
+            fprintf(
+                stderr, "run_decomposition(): Round %d needs more than %d rides\n", round,
+                ASSUMING_N_RIDE_PER_ENTITY
+            );
+            if (has_best_entity)
+                continue;
+            init_entity(&entity);
+        }
+
+        // Sectors never end worse than they started, so later rounds can only improve
+        copy_entity(best_entity, &entity);
+        best_fitness = compute_fitness(best_entity);
+        if (!has_best_entity)
+            first_fitness = best_fitness;
+        has_best_entity = true;
+
+        write_snapshot(best_entity, nullptr, 0, false);
+    }
+
+    write_snapshot(best_entity, nullptr, 0, true);
+
+    fprintf(
+        stderr, "Best fitnesses after %d rounds (of %d sectors): %d -> %d\n", round, sector_count,
+        first_fitness, best_fitness
+    );
+
+    return round;
+}
+
+/* --- MAIN FUNCTIONS --- */
+
+void parse_stdin()
+{
+    if (CURRENT_MODE == FINETUNE_MODE)
+    {
+        int seed;
+        cin >> N_ENTITIES >> MR_SWITCH_CUSTOMERS >> MR_MOVE_CUSTOMER >> MR_CREATE_RIDE >> seed;
+        cin.ignore();
+
+        std::srand(seed);
+    }
+
+    cin >> global_location_count;
+    cin.ignore();
+
+    cin >> global_vehicle_capacity;
+    cin.ignore();
+
+    if (global_location_count > MAX_CUSTOMERS + 1)
+    {
+        fprintf(
+            stderr, "parse_stdin(): %d locations > MAX_CUSTOMERS + 1 %d\n", global_location_count,
+            MAX_CUSTOMERS + 1
+        );
+        exit(0);
+    }
+
+    // cerr << global_location_count << " " << global_vehicle_capacity << endl;
+    // fprintf(
+    //     stderr, "parse_stdin: Location count: %d | Vehicle capacity: %d\n",
+    //     global_location_count, global_vehicle_capacity
+    // );
+
+    for (int i = 0; i < global_location_count; i++)
+    {
+
+        int id;     // The id of the location (0 is the depot)
+        int x;      // The x coordinate of the location
+        int y;      // The y coordinate of the location
+        int demand; // The demand
+        cin >> id >> x >> y >> demand;
+        // cerr << id << " " << x << " " << y << " " << demand << endl;
+
+        Location *location = &global_locations[i];
+        set_location_id(location, id);
+        set_location_x(location, x);
+        set_location_y(location, y);
+        set_location_demand(location, demand);
+
+        if (id != 0)
+            global_customer_ids[id - 1] = id;
+
+        cin.ignore();
+    }
+
+    // Depot is the first location in the list
+    global_customer_count = global_location_count - 1;
+
+    // Rides hold both a limited demand and a limited number of customers
+    int total_demand = 0;
+    for (int i = 1; i < global_location_count; i++)
+        total_demand += get_location_demand(&global_locations[i]);
+    int min_demand_ride_count = (total_demand + global_vehicle_capacity - 1) /
+                                global_vehicle_capacity;
+    int min_customer_ride_count = (global_customer_count + ASSUMING_N_CUSTOMER_PER_RIDE - 1) /
+                                  ASSUMING_N_CUSTOMER_PER_RIDE;
+    int min_ride_count = max(min_demand_ride_count, min_customer_ride_count);
+    if (min_ride_count * ASSUMING_RIDE_PACKING_PERCENT > ASSUMING_N_RIDE_PER_ENTITY * 100)
+    {
+        fprintf(
+            stderr,
+            "parse_stdin(): %d rides at least, too many for ASSUMING_N_RIDE_PER_ENTITY %d\n",
+            min_ride_count, ASSUMING_N_RIDE_PER_ENTITY
+        );
+        exit(0);
+    }
+
+    // for (int i = 0; i < global_customer_count; i++)
+    //     cerr << "Demand in location id " << i << ": " << global_customer_ids[i]
+    //          << endl; // 0 is the depot, so we skip the first custom
+
+    // cerr << "Parsed " << global_location_count << " locations" << endl;
+    // for (int i = 1; i < global_location_count; i++)
+    //     print_location(&global_locations[i]);
+
+    // cerr << "----------------------------------------" << endl;
+    // for (int i = 0; i < N_ENTITIES; i++)
+    //     cerr << "Entity " << i << " has " << get_entity_ride_count(population[i])
+    //          << " rides (fitness=" << compute_fitness(population[i])
+    //          << "): " << create_entity_string(population[i]) << endl;
+}
+
+void parse_arguments(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        string argument = argv[i];
+
+        if (argument == "--engine=auto")
+            ENGINE = AUTO_ENGINE;
+        else if (argument == "--engine=ga")
+            ENGINE = GA_ENGINE;
+        else if (argument == "--engine=sa")
+            ENGINE = SA_ENGINE;
+        else if (argument == "--engine=decomposition")
+            ENGINE = DECOMPOSITION_ENGINE;
+        else if (argument == "--sector-engine=ga")
+            SECTOR_ENGINE = GA_ENGINE;
+        else if (argument == "--sector-engine=sa")
+            SECTOR_ENGINE = SA_ENGINE;
+        else if (argument.rfind("--snapshot=", 0) == 0)
+            global_snapshot_path = argv[i] + strlen("--snapshot=");
+        else if (argument.rfind("--resume=", 0) == 0)
+            global_resume_path = argv[i] + strlen("--resume=");
+        else
+            fprintf(stderr, "parse_arguments(): Unknown argument %s\n", argv[i]);
+    }
+
+    if (ENGINE == AUTO_ENGINE)
+        ENGINE = choose_engine(global_customer_count);
+}
+
+const char *get_engine_name(int engine)
+{
+    if (engine == SA_ENGINE)
+        return "sa";
+    if (engine == DECOMPOSITION_ENGINE)
+        return "decomposition";
+    return "ga";
+}
+
+#if CURRENT_MODE != BENCHMARK_MODE
+int main(int argc, char **argv)
+{
+    parse_stdin();
+    parse_arguments(argc, argv);
+    init_distances();
+
+    struct rlimit rl;
+    getrlimit(RLIMIT_STACK, &rl);
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_STACK, &rl);
+
+    auto start = chrono::high_resolution_clock::now();
+
+    Entity resumed_entities[N_ENTITIES];
+    int    resumed_entity_count = 0;
+    if (global_resume_path)
+        resumed_entity_count = read_snapshot(global_resume_path, resumed_entities, N_ENTITIES);
+    Entity *resumed_entity = resumed_entity_count ? &resumed_entities[0] : nullptr;
+
+    Entity best_entity;
+    int    iteration_count;
+    if (ENGINE == DECOMPOSITION_ENGINE)
+        iteration_count = run_decomposition(&best_entity, start, resumed_entity);
+    else if (ENGINE == SA_ENGINE)
+        iteration_count =
+            run_simulated_annealing(&best_entity, start, N_ALLOWED_MILLISECONDS, resumed_entity);
+    else
+        iteration_count = run_genetic_algorithm(
+            &best_entity, start, N_ALLOWED_MILLISECONDS, resumed_entities, resumed_entity_count
+        );
+    int best_fitness = compute_fitness(&best_entity);
+
     if (CURRENT_MODE == CG_MODE)
-        cout << create_entity_string(best_entity) << endl;
+        cout << create_entity_string(&best_entity) << endl;
     else if (CURRENT_MODE == DEBUG_MODE)
-        cout << "ent=" << N_ENTITIES << " | gen=" << generation_count
-             << " | fitness=" << best_fitness << endl;
+        cout << "engine=" << get_engine_name(ENGINE) << " | ent=" << N_ENTITIES
+             << " | gen=" << iteration_count << " | fitness=" << best_fitness << endl;
     else if (CURRENT_MODE == FINETUNE_MODE)
         cout << best_fitness << endl;
 }
+#endif